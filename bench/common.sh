@@ -0,0 +1,67 @@
+# SPDX-License-Identifier: GPL-2.0
+#
+# Helpers sourced by the benchmark scripts. Everything runs inside network
+# namespaces named after the calling script's PID, which are removed on exit.
+
+BENCH_DIR="$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")"
+netns_server="wg-bench-$$-server"
+netns_client="wg-bench-$$-client"
+bench_tmp=""
+
+pretty() { echo -e "\x1b[32m\x1b[1m[+] ${1:+$1: }$2\x1b[0m" >&3; }
+pp() { pretty "" "$*"; "$@"; }
+server() { pretty server "$*"; ip netns exec "$netns_server" "$@"; }
+client() { pretty client "$*"; ip netns exec "$netns_client" "$@"; }
+ip_server() { pretty server "ip $*"; ip -n "$netns_server" "$@"; }
+ip_client() { pretty client "ip $*"; ip -n "$netns_client" "$@"; }
+
+require() {
+	local cmd
+	for cmd; do
+		type -p "$cmd" >/dev/null && continue
+		echo "$cmd is required to run this benchmark." >&2
+		exit 1
+	done
+	if (( EUID != 0 )); then
+		echo "This benchmark must be run as root." >&2
+		exit 1
+	fi
+}
+
+cleanup() {
+	set +e
+	exec 2>/dev/null
+	local n
+	for n in $(ip netns list | awk '{print $1}'); do
+		[[ $n == wg-bench-$$-* ]] && ip netns del "$n"
+	done
+	[[ -n $bench_tmp ]] && rm -rf "$bench_tmp"
+}
+
+# Sets up command echoing, cleanup on exit and a scratch directory in $bench_tmp.
+setup_bench() {
+	exec 3>&1
+	[[ -n $VERBOSE ]] || exec 3>/dev/null
+	trap cleanup EXIT
+	bench_tmp="$(mktemp -d)"
+}
+
+# Additionally creates the server namespace.
+setup_server() {
+	setup_bench
+	pp ip netns add "$netns_server"
+	ip_server link set lo up
+}
+
+# Additionally creates the client namespace, joined to the server by a veth
+# pair with 10.0.0.1/8 on the server side and 10.0.0.2/8 on the client side.
+setup_underlay() {
+	setup_server
+	pp ip netns add "$netns_client"
+	ip_client link set lo up
+	ip_server link add veth0 address 02:00:00:00:00:01 type veth peer name veth0 netns "$netns_client" address 02:00:00:00:00:02
+	ip_server addr add 10.0.0.1/8 dev veth0
+	ip_client addr add 10.0.0.2/8 dev veth0
+	ip_server link set veth0 up
+	ip_client link set veth0 up
+}
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0
+#
+# Handshake initiation generator used by handshake-flood.sh. Simulated client
+# keys are derived from their index, so that the peer list given to the
+# device under test and the generator agree without exchanging key files.
+
+import argparse
+import base64
+import multiprocessing
+import os
+import selectors
+import socket
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import wgnoise
+
+
+def client_private_key(index):
+	return wgnoise.blake2s(b"wg-bench-client", struct.pack("<I", index))
+
+
+def source_address(base, index):
+	a = socket.inet_aton(base)
+	return socket.inet_ntoa(struct.pack(">I", struct.unpack(">I", a)[0] + index))
+
+
+def read_cpu():
+	with open("/proc/stat") as f:
+		fields = [int(x) for x in f.readline().split()[1:]]
+	# user nice system idle iowait irq softirq steal
+	return sum(fields[:8]), fields[3] + fields[4], fields[6]
+
+
+def cmd_peers(args):
+	for i in range(args.clients):
+		print("[Peer]")
+		print("PublicKey = %s" % base64.b64encode(wgnoise.public_key(client_private_key(i))).decode())
+		print()
+
+
+def worker(args, server_public, job, start, conn):
+	clients = [wgnoise.Initiator(client_private_key(i), server_public, reuse_ephemeral=not args.fresh_ephemeral)
+		   for i in range(job, args.clients, args.jobs)]
+	sockets = []
+	sel = selectors.DefaultSelector()
+	for s in range(job, args.sources, args.jobs):
+		sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+		sock.bind((source_address(args.source_base, s), 0))
+		sock.setblocking(False)
+		sel.register(sock, selectors.EVENT_READ)
+		sockets.append(sock)
+	weights = [int(x) for x in args.mix.split(":")]
+	if len(weights) != 3 or sum(weights) <= 0:
+		raise SystemExit("--mix must be valid:forged:junk")
+	kinds = [k for k, w in zip(("valid", "forged", "junk"), weights) for _ in range(w)]
+	sent = dict.fromkeys(("valid", "forged", "junk"), 0)
+	received = {"responses": 0, "cookies": 0, "cookies_accepted": 0}
+	dest = (args.server, args.port)
+	rate = args.rate / args.jobs
+	n = 0
+	while time.monotonic() < start:
+		time.sleep(0.001)
+	end = start + args.duration
+	cpu_start = os.times()
+
+	def drain(timeout):
+		for key, _ in sel.select(timeout):
+			while True:
+				try:
+					msg = key.fileobj.recv(2048)
+				except BlockingIOError:
+					break
+				if msg[0] == wgnoise.MESSAGE_HANDSHAKE_RESPONSE:
+					received["responses"] += 1
+				elif msg[0] == wgnoise.MESSAGE_HANDSHAKE_COOKIE:
+					received["cookies"] += 1
+					index = struct.unpack_from("<I", msg, 4)[0]
+					if index < args.clients and index % args.jobs == job:
+						received["cookies_accepted"] += clients[index // args.jobs].consume_cookie(msg)
+
+	while True:
+		now = time.monotonic()
+		if now >= end:
+			break
+		due = start + n / rate
+		if due > now:
+			drain(due - now)
+			continue
+		# Every client gets one initiation per pass over all clients, so none
+		# exceeds rate / clients, and the kinds rotate between passes.
+		c = n % len(clients)
+		kind = kinds[(n + n // len(clients)) % len(kinds)]
+		index = job + c * args.jobs
+		if kind == "valid":
+			msg = clients[c].initiation(index)
+		elif kind == "forged":
+			msg = wgnoise.forged_initiation(server_public, index)
+		else:
+			msg = wgnoise.junk_initiation()
+		try:
+			sockets[c % len(sockets)].sendto(msg, dest)
+			sent[kind] += 1
+		except BlockingIOError:
+			drain(0)
+		n += 1
+	drain_end = time.monotonic() + args.linger
+	while time.monotonic() < drain_end:
+		drain(drain_end - time.monotonic())
+	cpu_end = os.times()
+	conn.send((sent, received, (cpu_end.user + cpu_end.system) - (cpu_start.user + cpu_start.system)))
+	conn.close()
+
+
+def cmd_flood(args):
+	server_public = base64.b64decode(args.server_key)
+	args.jobs = min(args.jobs, args.clients, args.sources)
+	start = time.monotonic() + 1.0 + args.clients / 2000
+	procs = []
+	for job in range(args.jobs):
+		parent, child = multiprocessing.Pipe(False)
+		p = multiprocessing.Process(target=worker, args=(args, server_public, job, start, child))
+		p.start()
+		procs.append((p, parent))
+	while time.monotonic() < start:
+		time.sleep(0.001)
+	cpu_start, wall_start = read_cpu(), time.monotonic()
+	sent = dict.fromkeys(("valid", "forged", "junk"), 0)
+	received = dict.fromkeys(("responses", "cookies", "cookies_accepted"), 0)
+	generator_cpu = 0.0
+	for p, conn in procs:
+		s, r, cpu = conn.recv()
+		p.join()
+		for k in s:
+			sent[k] += s[k]
+		for k in r:
+			received[k] += r[k]
+		generator_cpu += cpu
+	cpu_end, wall = read_cpu(), time.monotonic() - wall_start
+	hz = os.sysconf("SC_CLK_TCK")
+	ncpu = os.cpu_count()
+	total = (cpu_end[0] - cpu_start[0]) / hz
+	idle = (cpu_end[1] - cpu_start[1]) / hz
+	softirq = (cpu_end[2] - cpu_start[2]) / hz
+	busy = total - idle
+	print("duration:            %.2f s (%d clients, %d sources, %d jobs)" % (args.duration, args.clients, args.sources, args.jobs))
+	print("initiations sent:    %d valid, %d forged, %d junk (%.0f/s)" % (sent["valid"], sent["forged"], sent["junk"], sum(sent.values()) / args.duration))
+	print("handshake responses: %d (%.0f handshakes/s)" % (received["responses"], received["responses"] / args.duration))
+	print("cookie replies:      %d (%d accepted)" % (received["cookies"], received["cookies_accepted"]))
+	print("cpu busy:            %.2f of %d cpus, %.2f in softirq, %.2f in generator" % (busy / wall, ncpu, softirq / wall, generator_cpu / wall))
+	print("cpu excl. generator: %.2f cpus, %.1f us per handshake" % (max(busy - generator_cpu, 0) / wall,
+	      1e6 * max(busy - generator_cpu, 0) / max(received["responses"], 1)))
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Generate WireGuard handshake load.")
+	sub = parser.add_subparsers(dest="command", required=True)
+	p = sub.add_parser("peers", help="print [Peer] sections for the simulated clients")
+	p.add_argument("--clients", type=int, default=1000)
+	p.set_defaults(func=cmd_peers)
+	p = sub.add_parser("flood", help="send initiations and report results")
+	p.add_argument("--server", required=True)
+	p.add_argument("--port", type=int, default=51820)
+	p.add_argument("--server-key", required=True, help="base64 public key of the device under test")
+	p.add_argument("--clients", type=int, default=1000)
+	p.add_argument("--sources", type=int, default=1, help="number of consecutive source addresses to use")
+	p.add_argument("--source-base", default="10.1.0.1")
+	p.add_argument("--rate", type=float, default=1000, help="initiations per second")
+	p.add_argument("--duration", type=float, default=10)
+	p.add_argument("--linger", type=float, default=1, help="seconds to wait for late replies")
+	p.add_argument("--mix", default="1:0:0", help="ratio of valid:forged:junk initiations")
+	p.add_argument("--jobs", type=int, default=max(os.cpu_count() // 2, 1))
+	p.add_argument("--fresh-ephemeral", action="store_true", help="do a new ephemeral DH for every initiation")
+	p.set_defaults(func=cmd_flood)
+	args = parser.parse_args()
+	args.func(args)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,36 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Measures handshake capacity of the running kernel's WireGuard: a device with
+# $CLIENTS peers is created in one namespace and flooded with initiations from
+# simulated clients in another, using $SOURCES distinct source addresses so
+# that the per-source ratelimiter behaves as with real clients. Remaining
+# arguments are passed to `handshake-flood.py flood`, for example:
+#
+#   CLIENTS=10000 SOURCES=2000 ./handshake-flood.sh --rate 50000 --mix 8:1:1
+
+set -e
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/common.sh"
+
+CLIENTS="${CLIENTS:-1000}"
+SOURCES="${SOURCES:-256}"
+
+require ip wg python3
+setup_underlay
+
+key="$(wg genkey)"
+ip_server link add wg0 type wireguard
+server wg setconf wg0 <(printf '[Interface]\nPrivateKey = %s\nListenPort = 51820\n\n' "$key"; python3 "$BENCH_DIR/handshake-flood.py" peers --clients "$CLIENTS")
+ip_server link set wg0 up
+
+# Source addresses live on the client's loopback and are routed through the
+# client's veth address, so the server needs only one neighbour entry.
+for (( i = 0; i < SOURCES; ++i )); do
+	a=$(( 0x0a010001 + i ))
+	echo "addr add $(( a >> 24 )).$(( (a >> 16) & 255 )).$(( (a >> 8) & 255 )).$(( a & 255 ))/32 dev lo"
+done | ip -n "$netns_client" -b -
+ip_server route add 10.1.0.0/16 via 10.0.0.2
+
+client python3 "$BENCH_DIR/handshake-flood.py" flood --server 10.0.0.1 --server-key "$(wg pubkey <<<"$key")" \
+	--clients "$CLIENTS" --sources "$SOURCES" --source-base 10.1.0.1 "$@"
+echo "peers with handshake: $(server wg show wg0 latest-handshakes | awk '$2 != 0' | wc -l) of $CLIENTS"
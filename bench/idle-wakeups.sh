@@ -0,0 +1,118 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Counts the timer expirations and workqueue items run on behalf of an idle
+# WireGuard tunnel, which is what keeps an always-on VPN from letting the CPU
+# sleep. By default a tunnel with a persistent keepalive of $KEEPALIVE seconds
+# is set up between two namespaces and left idle. Both ends run in the same
+# kernel, so the counts are those of the client and the server together. With
+# NETNS=0, the tunnels already configured on the system are measured instead,
+# which is how to run this on a phone or in a qemu guest with a real peer.
+# Only WireGuard's own functions are traced, in a private tracefs instance
+# with in-kernel filters, so that nothing wakes up to consume events during
+# the $DURATION seconds.
+#
+#   DURATION=3600 KEEPALIVE=25 ./idle-wakeups.sh
+
+set -e
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/common.sh"
+
+DURATION="${DURATION:-600}"
+KEEPALIVE="${KEEPALIVE:-25}"
+NETNS="${NETNS:-1}"
+SETTLE="${SETTLE:-5}"
+
+require awk
+if [[ $NETNS == 1 ]]; then
+	require ip wg ping
+fi
+
+for tracefs in /sys/kernel/tracing /sys/kernel/debug/tracing; do
+	[[ -d $tracefs/instances ]] && break
+done
+if [[ ! -d $tracefs/instances ]]; then
+	echo "tracefs must be mounted, with instances support." >&2
+	exit 1
+fi
+instance="$tracefs/instances/wg-bench-$$"
+
+if [[ $NETNS == 1 ]]; then
+	setup_underlay
+	key1="$(wg genkey)"
+	key2="$(wg genkey)"
+	ip_server link add wg0 type wireguard
+	ip_client link add wg0 type wireguard
+	server wg set wg0 private-key <(echo "$key1") listen-port 51820 peer "$(wg pubkey <<<"$key2")" allowed-ips 192.168.241.2/32
+	client wg set wg0 private-key <(echo "$key2") peer "$(wg pubkey <<<"$key1")" allowed-ips 192.168.241.1/32 \
+		endpoint 10.0.0.1:51820 persistent-keepalive "$KEEPALIVE"
+	ip_server addr add 192.168.241.1/24 dev wg0
+	ip_client addr add 192.168.241.2/24 dev wg0
+	ip_server link set wg0 up
+	ip_client link set wg0 up
+	client ping -q -c 1 -w 5 192.168.241.1 > /dev/null
+	scope="client and server ends together"
+else
+	setup_bench
+	scope="all tunnels on this system"
+fi
+trap 'rmdir "$instance" 2>/dev/null; cleanup' EXIT
+
+# The timer and work callbacks among WireGuard's text symbols, restricted to
+# the module's own symbols when it is built as one. Both the wg_ prefixed and
+# the older unprefixed names are recognized.
+awk '
+	$2 ~ /^[tT]$/ && $3 ~ /^(wg_)?(expired_[a-z_]+|queued_expired_[a-z_]+|packet_[a-z_]+_worker|ratelimiter_gc_entries|gc_entries)$/ {
+		sym[++n] = $1 " " $3; mod[n] = $4
+		if ($4 == "[wireguard]") module = 1
+	}
+	END { for (i = 1; i <= n; ++i) if (!module || mod[i] == "[wireguard]") print sym[i] }
+' /proc/kallsyms | sort -u > "$bench_tmp/symbols"
+if [[ ! -s $bench_tmp/symbols ]] || [[ $(awk 'NR == 1 { print $1 }' "$bench_tmp/symbols") =~ ^0+$ ]]; then
+	echo "Unable to read WireGuard symbol addresses from /proc/kallsyms." >&2
+	exit 1
+fi
+filter="$(awk '{ printf "%sfunction == 0x%s", (NR > 1 ? " || " : ""), $1 }' "$bench_tmp/symbols")"
+
+pretty "" "Letting the tunnel settle for $SETTLE seconds"
+sleep "$SETTLE"
+pp mkdir "$instance"
+echo 1024 > "$instance/buffer_size_kb"
+for event in timer/timer_expire_entry workqueue/workqueue_execute_start; do
+	echo "$filter" > "$instance/events/$event/filter"
+	echo 1 > "$instance/events/$event/enable"
+done
+pretty "" "Tracing for $DURATION seconds"
+sleep "$DURATION"
+echo 0 > "$instance/tracing_on"
+
+# A keepalive tunnel cannot go longer than its keepalive interval without a
+# single callback, so no events at all means that the filter never matched,
+# as with clang CFI, where timers and work items point at jump table entries
+# rather than at the functions themselves.
+if ! grep -q -E 'timer_expire_entry:|workqueue_execute_start:' "$instance/trace"; then
+	if [[ $NETNS == 1 ]] && (( DURATION >= KEEPALIVE )); then
+		echo "No events matched the WireGuard symbol addresses from /proc/kallsyms; is this a CFI kernel?" >&2
+		exit 1
+	fi
+	echo "Warning: no events matched; either the tunnels were idle or the symbol addresses do not match those in timers and work items." >&2
+fi
+
+awk '
+	/timer_expire_entry:/ || /workqueue_execute_start:/ {
+		kind = /timer_expire_entry:/ ? "timer" : "work"
+		if (match($0, /function[= ][^ ]+/)) {
+			count[kind " " substr($0, RSTART + 9, RLENGTH - 9)]++
+			total[kind]++
+		}
+	}
+	END {
+		for (k in count)
+			printf "  %-6s %-48s %8d %10.1f/h\n", substr(k, 1, index(k, " ") - 1), substr(k, index(k, " ") + 1), count[k], count[k] * 3600 / duration | "sort -k3 -n -r"
+		close("sort -k3 -n -r")
+		printf "timers: %d, work items: %d over %d s\n", total["timer"], total["work"], duration
+		printf "wakeups per hour: %.1f (%s)\n", (total["timer"] + total["work"]) * 3600 / duration, scope
+	}
+' duration="$DURATION" scope="$scope" "$instance/trace"
+if grep -q 'LOST' "$instance/trace"; then
+	echo "Warning: events were lost; increase buffer_size_kb or reduce DURATION." >&2
+fi
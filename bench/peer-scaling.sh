@@ -0,0 +1,81 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Measures how the running kernel's WireGuard scales with the number of peers:
+# for each count given as an argument, a device is loaded with that many
+# synthetic peers, each with one IPv4 and one IPv6 allowed IP, and the time to
+# add them, dump them and remove them via netlink is recorded along with the
+# slab memory they occupy. Each result is appended to $RESULTS, tagged with the
+# module version, and the table of all results is printed, so that runs
+# against different snapshots can be compared.
+#
+#   RESULTS=~/wg-scaling.tsv ./peer-scaling.sh 10000 100000 1000000
+
+set -e
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/common.sh"
+
+RESULTS="${RESULTS:-peer-scaling.tsv}"
+(( $# )) || set -- 10000 100000 1000000
+
+require ip wg python3
+setup_server
+
+version="$(cat /sys/module/wireguard/version 2>/dev/null || echo unknown)"
+[[ -s $RESULTS ]] || printf 'version\tpeers\tadd_ms\tdump_ms\tremove_ms\tslab_kb\tbytes_per_peer\tleaked_kb\n' > "$RESULTS"
+
+timed() {
+	local start
+	start="$(date +%s%N)"
+	"$@"
+	elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+}
+
+# Total slab usage in kilobytes, after letting pending RCU frees complete.
+slab_kb() {
+	sleep 2
+	awk '/^Slab:/ { print $2 }' /proc/meminfo
+}
+
+slab_caches() {
+	awk 'NR > 2 { print $1, $3 * $4 }' /proc/slabinfo | sort
+}
+
+key="$(wg genkey)"
+ip_server link add wg0 type wireguard
+server wg set wg0 private-key <(echo "$key") listen-port 51820
+ip_server link set wg0 up
+
+for peers in "$@"; do
+	pretty "" "Generating $peers peers"
+	python3 - "$peers" > "$bench_tmp/peers.conf" <<-'_EOF'
+	import base64, os, sys
+	for i in range(int(sys.argv[1])):
+	    print("[Peer]\nPublicKey = %s\nAllowedIPs = 10.%d.%d.%d/32, fd00::%x:%x/128\n" %
+	          (base64.b64encode(os.urandom(32)).decode(), i >> 16 & 255, i >> 8 & 255, i & 255, i >> 16, i & 0xffff))
+	_EOF
+	{ printf '[Interface]\nPrivateKey = %s\nListenPort = 51820\n\n' "$key"; cat "$bench_tmp/peers.conf"; } > "$bench_tmp/full.conf"
+	printf '[Interface]\nPrivateKey = %s\nListenPort = 51820\n' "$key" > "$bench_tmp/empty.conf"
+
+	slab_caches > "$bench_tmp/caches.before"
+	slab_before="$(slab_kb)"
+	timed server wg setconf wg0 "$bench_tmp/full.conf"
+	add_ms=$elapsed
+	slab_after="$(slab_kb)"
+	slab_caches > "$bench_tmp/caches.after"
+	timed server wg show wg0 dump > /dev/null
+	dump_ms=$elapsed
+	timed server wg setconf wg0 "$bench_tmp/empty.conf"
+	remove_ms=$elapsed
+	slab_removed="$(slab_kb)"
+
+	slab=$(( slab_after - slab_before ))
+	printf '%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n' "$version" "$peers" "$add_ms" "$dump_ms" "$remove_ms" \
+		"$slab" $(( slab * 1024 / peers )) $(( slab_removed - slab_before )) >> "$RESULTS"
+
+	echo "Largest slab cache growth for $peers peers:"
+	join "$bench_tmp/caches.before" "$bench_tmp/caches.after" | \
+		awk -v peers="$peers" '$3 > $2 { printf "  %-28s %10d kB %8.1f B/peer\n", $1, ($3 - $2) / 1024, ($3 - $2) / peers }' | \
+		sort -k2 -n -r | head -n 8
+done
+
+awk -F '\t' '{ printf "%-24s %8s %8s %8s %9s %9s %14s %9s\n", $1, $2, $3, $4, $5, $6, $7, $8 }' "$RESULTS"
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0
+#
+# Receive path load generator used by replay-inject.sh. Each sender completes
+# a real handshake with the device under test, precomputes a corpus of
+# encrypted data messages as complete Ethernet frames, and then writes them to
+# the underlay interface with a raw packet socket, bypassing the qdisc and the
+# sender's own IP and UDP stack.
+
+import argparse
+import base64
+import errno
+import json
+import multiprocessing
+import os
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import wgnoise
+
+SOL_PACKET = 263
+PACKET_QDISC_BYPASS = 20
+MODES = ("valid", "replay", "allowedips", "badauth")
+
+
+def sender_private_key(index):
+	return wgnoise.blake2s(b"wg-bench-sender", struct.pack("<I", index))
+
+
+def checksum(header):
+	s = sum(struct.unpack("!%dH" % (len(header) // 2), header))
+	s = (s & 0xffff) + (s >> 16)
+	s = (s & 0xffff) + (s >> 16)
+	return struct.pack("!H", ~s & 0xffff)
+
+
+def ipv4_udp(src, dst, sport, dport, payload_len):
+	total = 20 + 8 + payload_len
+	ip = struct.pack("!BBHHHBBH4s4s", 0x45, 0, total, 0, 0x4000, 64, socket.IPPROTO_UDP, 0,
+			 socket.inet_aton(src), socket.inet_aton(dst))
+	ip = ip[:10] + checksum(ip) + ip[12:]
+	return ip + struct.pack("!HHHH", sport, dport, 8 + payload_len, 0)
+
+
+def inner_source(index, mode):
+	return "10.%d.%d.%d" % (201 if mode == "allowedips" else 200, index >> 8 & 255, index & 255)
+
+
+def read_cpu():
+	with open("/proc/stat") as f:
+		fields = [int(x) for x in f.readline().split()[1:]]
+	# user nice system idle iowait irq softirq steal
+	return sum(fields[:8]) - fields[3] - fields[4]
+
+
+def cmd_peers(args):
+	for i in range(args.senders):
+		print("[Peer]")
+		print("PublicKey = %s" % base64.b64encode(wgnoise.public_key(sender_private_key(i))).decode())
+		print("AllowedIPs = %s/32" % inner_source(i, "valid"))
+		print()
+
+
+def handshake(args, index, server_public, sock):
+	initiator = wgnoise.Initiator(sender_private_key(index), server_public, reuse_ephemeral=False)
+	sock.settimeout(1)
+	for _ in range(10):
+		sock.sendto(initiator.initiation(index), (args.server, args.port))
+		try:
+			while True:
+				msg = sock.recv(2048)
+				if msg[0] == wgnoise.MESSAGE_HANDSHAKE_COOKIE:
+					initiator.consume_cookie(msg)
+					break
+				keypair = initiator.consume_response(msg)
+				if keypair:
+					return keypair
+		except socket.timeout:
+			pass
+	raise SystemExit("sender %d: no handshake response from %s:%d" % (index, args.server, args.port))
+
+
+def prepare(args, index, server_public):
+	sport = args.source_port + index
+	sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+	sock.bind((args.source, sport))
+	keypair = handshake(args, index, server_public, sock)
+
+	payload_len = args.size - 28
+	inner = ipv4_udp(inner_source(index, args.mode), args.inner_destination, 9, 9, payload_len) + bytes(payload_len)
+	message_len = 16 + len(inner) + (-len(inner) % 16) + 16
+	with open("/sys/class/net/%s/address" % args.interface) as f:
+		source_mac = bytes.fromhex(f.read().strip().replace(":", ""))
+	prefix = bytes.fromhex(args.destination_mac.replace(":", "")) + source_mac + b"\x08\x00" + \
+		 ipv4_udp(args.source, args.server, sport, args.port, message_len)
+
+	start = time.monotonic()
+	if args.mode == "replay":
+		frames = [prefix + keypair.data(0, inner)] * args.packets
+	else:
+		frames = [prefix + keypair.data(counter, inner) for counter in range(args.packets)]
+	if args.mode == "badauth":
+		frames = [f[:-1] + bytes([f[-1] ^ 1]) for f in frames]
+	precompute = time.monotonic() - start
+
+	raw = socket.socket(socket.AF_PACKET, socket.SOCK_RAW, 0)
+	raw.setsockopt(SOL_PACKET, PACKET_QDISC_BYPASS, 1)
+	raw.bind((args.interface, 0))
+	return frames, precompute, raw
+
+
+def sender(args, index, server_public, barrier, conn):
+	try:
+		frames, precompute, raw = prepare(args, index, server_public)
+	except BaseException:
+		barrier.abort()
+		raise
+	barrier.wait()
+	start, user = time.monotonic(), os.times().user
+	sent = 0
+	for frame in frames:
+		while True:
+			try:
+				raw.send(frame)
+				sent += 1
+				break
+			except BlockingIOError:
+				pass
+			except OSError as e:
+				if e.errno != errno.ENOBUFS:
+					raise
+	conn.send((sent, precompute, time.monotonic() - start, os.times().user - user))
+	conn.close()
+
+
+def device_stats(args):
+	out = subprocess.check_output(["ip", "-n", args.stats_netns, "-j", "-s", "link", "show", "dev", args.stats_device])
+	return json.loads(out)[0]["stats64"]["rx"]
+
+
+def cmd_inject(args):
+	server_public = base64.b64decode(args.server_key)
+	barrier = multiprocessing.Barrier(args.senders + 1)
+	procs = []
+	for i in range(args.senders):
+		parent, child = multiprocessing.Pipe(False)
+		p = multiprocessing.Process(target=sender, args=(args, i, server_public, barrier, child))
+		p.start()
+		procs.append((p, parent))
+	# The senders start writing as soon as the barrier releases them, so the
+	# baseline must be taken before the parent joins it.
+	before = device_stats(args)
+	try:
+		barrier.wait()
+	except threading.BrokenBarrierError:
+		for p, _ in procs:
+			p.terminate()
+		raise SystemExit(1)
+	cpu, start = read_cpu(), time.monotonic()
+	results = []
+	for p, conn in procs:
+		results.append(conn.recv())
+		p.join()
+	elapsed = max(r[2] for r in results)
+	time.sleep(args.settle)
+	after, cpu, window = device_stats(args), read_cpu() - cpu, time.monotonic() - start
+	cpu = cpu / os.sysconf("SC_CLK_TCK") - sum(r[3] for r in results)
+	sent = sum(r[0] for r in results)
+	delivered = after["packets"] - before["packets"]
+	print("mode:            %s, %d byte inner packets, %d senders" % (args.mode, args.size, args.senders))
+	print("precompute:      %.2f s per %d packets" % (max(r[1] for r in results), args.packets))
+	print("injected:        %d packets in %.2f s (%.0f pps, %.2f Gbit/s inner)" % (sent, elapsed, sent / elapsed, sent * args.size * 8 / elapsed / 1e9))
+	print("delivered:       %d packets (%.0f pps over %.2f s incl. settle)" % (delivered, delivered / window, window))
+	print("rx errors:       %d, rx dropped: %d" % (after["errors"] - before["errors"], after["dropped"] - before["dropped"]))
+	print("cpu:             %.2f cpus excl. sender userspace, %.2f us per injected packet" % (cpu / window, 1e6 * max(cpu, 0) / max(sent, 1)))
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Inject precomputed WireGuard data messages.")
+	sub = parser.add_subparsers(dest="command", required=True)
+	p = sub.add_parser("peers", help="print [Peer] sections for the senders")
+	p.add_argument("--senders", type=int, default=1)
+	p.set_defaults(func=cmd_peers)
+	p = sub.add_parser("inject", help="handshake, precompute and inject")
+	p.add_argument("--server", required=True)
+	p.add_argument("--port", type=int, default=51820)
+	p.add_argument("--server-key", required=True, help="base64 public key of the device under test")
+	p.add_argument("--source", required=True, help="underlay address of the interface")
+	p.add_argument("--source-port", type=int, default=40000)
+	p.add_argument("--interface", required=True, help="underlay interface to write frames to")
+	p.add_argument("--destination-mac", required=True, help="MAC address of the device under test's underlay")
+	p.add_argument("--inner-destination", default="192.168.0.1")
+	p.add_argument("--stats-netns", required=True)
+	p.add_argument("--stats-device", default="wg0")
+	p.add_argument("--senders", type=int, default=1)
+	p.add_argument("--packets", type=int, default=100000, help="corpus size per sender")
+	p.add_argument("--size", type=int, default=1420, help="inner packet size")
+	p.add_argument("--mode", choices=MODES, default="valid")
+	p.add_argument("--settle", type=float, default=0.5, help="seconds to wait for queued packets")
+	p.set_defaults(func=cmd_inject)
+	args = parser.parse_args()
+	args.func(args)
+
+
+if __name__ == "__main__":
+	main()
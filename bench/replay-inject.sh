@@ -0,0 +1,34 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Benchmarks the receive path of the running kernel's WireGuard in isolation:
+# $SENDERS peers handshake with a device in one namespace, then a corpus of
+# precomputed data messages is written to the underlay from another, so the
+# sender does no encryption while the device is measured. Remaining arguments
+# are passed to `replay-inject.py inject`. Comparing the delivered rate of the
+# modes separates the stages of the receive path:
+#
+#   badauth     decryption failure
+#   replay      decryption and replay rejection
+#   allowedips  decryption, replay check and allowed IPs rejection
+#   valid       full path up to delivery to the inner stack
+#
+#   SENDERS=4 ./replay-inject.sh --mode allowedips --size 1420
+
+set -e
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/common.sh"
+
+SENDERS="${SENDERS:-1}"
+
+require ip wg python3
+setup_underlay
+
+key="$(wg genkey)"
+ip_server link add wg0 type wireguard
+server wg setconf wg0 <(printf '[Interface]\nPrivateKey = %s\nListenPort = 51820\n\n' "$key"; python3 "$BENCH_DIR/replay-inject.py" peers --senders "$SENDERS")
+ip_server addr add 192.168.0.1/24 dev wg0
+ip_server link set wg0 up
+
+client python3 "$BENCH_DIR/replay-inject.py" inject --server 10.0.0.1 --server-key "$(wg pubkey <<<"$key")" \
+	--source 10.0.0.2 --interface veth0 --destination-mac 02:00:00:00:00:01 \
+	--inner-destination 192.168.0.1 --stats-netns "$netns_server" --senders "$SENDERS" "$@"
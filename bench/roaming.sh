@@ -0,0 +1,114 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Measures how long the running kernel's WireGuard takes to recover when a
+# client moves between two underlay networks, as a phone does when switching
+# between Wi-Fi and cellular. The client namespace has two uplinks to the
+# server, only one of which is attached at a time, and pings the server
+# through the tunnel every $INTERVAL seconds. Each of $ROUNDS rounds detaches
+# the current uplink, attaches the other one, and records the time until the
+# first inner ping reply arrives, along with the handshakes seen by the server.
+#
+# With MODE=addr (the default), the old uplink loses its address, as on
+# Android; with MODE=link, the link only goes down and keeps its address.
+#
+#   ROUNDS=20 INTERVAL=0.005 ./roaming.sh
+
+set -e
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/common.sh"
+
+ROUNDS="${ROUNDS:-10}"
+INTERVAL="${INTERVAL:-0.01}"
+TIMEOUT="${TIMEOUT:-15}"
+MODE="${MODE:-addr}"
+
+require ip wg ping iptables awk
+setup_server
+pp ip netns add "$netns_client"
+ip_client link set lo up
+
+# The server is reachable at 192.0.2.1 through either uplink.
+ip_server addr add 192.0.2.1/32 dev lo
+for i in 0 1; do
+	ip_server link add "uplink$i" type veth peer name "uplink$i" netns "$netns_client"
+	ip_server addr add "10.$i.0.1/24" dev "uplink$i"
+	ip_server link set "uplink$i" up
+done
+
+key1="$(wg genkey)"
+key2="$(wg genkey)"
+ip_server link add wg0 type wireguard
+ip_client link add wg0 type wireguard
+server wg set wg0 private-key <(echo "$key1") listen-port 51820 peer "$(wg pubkey <<<"$key2")" allowed-ips 192.168.241.2/32
+client wg set wg0 private-key <(echo "$key2") peer "$(wg pubkey <<<"$key1")" allowed-ips 192.168.241.1/32 endpoint 192.0.2.1:51820
+ip_server addr add 192.168.241.1/24 dev wg0
+ip_client addr add 192.168.241.2/24 dev wg0
+ip_server link set wg0 up
+ip_client link set wg0 up
+
+# Handshake initiations and responses are the only WireGuard messages with an
+# IPv4 total length of 176 and 120 bytes respectively.
+server iptables -A INPUT -p udp --dport 51820 -m length --length 176
+server iptables -A OUTPUT -p udp --sport 51820 -m length --length 120
+
+attach() {
+	ip_client addr replace "10.$1.0.2/24" dev "uplink$1"
+	ip_client link set "uplink$1" up
+	ip_client route replace default via "10.$1.0.1" dev "uplink$1"
+}
+
+detach() {
+	[[ $MODE == link ]] || ip_client addr flush dev "uplink$1"
+	ip_client link set "uplink$1" down
+}
+
+rule_packets() {
+	server iptables -L "$1" -v -x -n | awk '/udp/ { print $1; exit }'
+}
+
+now() {
+	local t
+	t="$(date +%s%N)"
+	echo "${t:0:-9}.${t: -9}"
+}
+
+attach 0
+ip netns exec "$netns_client" ping -q -c 1 -w "$TIMEOUT" 192.168.241.1 > /dev/null
+
+current=0
+results=()
+printf '%-6s %-10s %12s %12s %10s\n' round uplink recovery_ms initiations responses
+for (( round = 1; round <= ROUNDS; ++round )); do
+	next=$(( !current ))
+	ip netns exec "$netns_client" ping -D -n -i "$INTERVAL" 192.168.241.1 > "$bench_tmp/ping" 2>&1 &
+	ping_pid=$!
+	sleep 1
+	initiations="$(rule_packets INPUT)"
+	responses="$(rule_packets OUTPUT)"
+	# The clock starts once the old uplink is gone, and only replies to
+	# requests sent after that count, not those still in flight on it.
+	detach "$current"
+	t0="$(now)"
+	seq0="$(awk '/bytes from/ && match($0, /icmp_seq=[0-9]+/) { s = substr($0, RSTART + 9, RLENGTH - 9) + 0 } END { print s + 0 }' "$bench_tmp/ping")"
+	attach "$next"
+	recovery=""
+	for (( i = 0; i < TIMEOUT * 100; ++i )); do
+		recovery="$(awk -v t0="$t0" -v seq0="$seq0" '
+			/bytes from/ && match($0, /icmp_seq=[0-9]+/) && substr($0, RSTART + 9, RLENGTH - 9) + 0 > seq0 + 0 {
+				t = substr($1, 2, length($1) - 2) + 0
+				if (t > t0 + 0) { printf "%.1f", (t - t0) * 1000; exit }
+			}' "$bench_tmp/ping")"
+		[[ -z $recovery ]] || break
+		sleep 0.01
+	done
+	sleep 0.5
+	kill "$ping_pid"
+	wait "$ping_pid" || true
+	printf '%-6d %-10s %12s %12d %10d\n' "$round" "$current->$next" "${recovery:-timeout}" \
+		$(( $(rule_packets INPUT) - initiations )) $(( $(rule_packets OUTPUT) - responses ))
+	[[ -z $recovery ]] || results+=( "$recovery" )
+	current=$next
+done
+
+(( ${#results[@]} )) || exit 1
+printf '%s\n' "${results[@]}" | sort -n | awk '{ v[NR] = $1 } END { printf "recovered %d/%d rounds: min %.1f ms, median %.1f ms, max %.1f ms\n", NR, '"$ROUNDS"', v[1], v[int((NR + 1) / 2)], v[NR] }'
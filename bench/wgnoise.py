@@ -0,0 +1,217 @@
+# SPDX-License-Identifier: GPL-2.0
+#
+# Minimal userspace implementation of the initiator side of the WireGuard
+# handshake and of transport data messages, sufficient for driving a kernel
+# WireGuard device from benchmarks. Requires python3-cryptography.
+
+import hashlib
+import hmac
+import os
+import struct
+import time
+
+from cryptography.hazmat.primitives.asymmetric.x25519 import X25519PrivateKey, X25519PublicKey
+from cryptography.hazmat.primitives.ciphers.aead import ChaCha20Poly1305
+from cryptography.hazmat.primitives import serialization
+
+CONSTRUCTION = b"Noise_IKpsk2_25519_ChaChaPoly_BLAKE2s"
+IDENTIFIER = b"WireGuard v1 zx2c4 Jason@zx2c4.com"
+LABEL_MAC1 = b"mac1----"
+LABEL_COOKIE = b"cookie--"
+
+MESSAGE_HANDSHAKE_INITIATION = 1
+MESSAGE_HANDSHAKE_RESPONSE = 2
+MESSAGE_HANDSHAKE_COOKIE = 3
+MESSAGE_DATA = 4
+
+INITIATION_LEN = 148
+RESPONSE_LEN = 92
+COOKIE_REPLY_LEN = 64
+
+RAW = serialization.Encoding.Raw
+
+
+def blake2s(*parts):
+	h = hashlib.blake2s()
+	for p in parts:
+		h.update(p)
+	return h.digest()
+
+
+def mac(key, data):
+	return hashlib.blake2s(data, digest_size=16, key=key).digest()
+
+
+def hmac_blake2s(key, data):
+	return hmac.new(key, data, hashlib.blake2s).digest()
+
+
+def kdf(key, data, n):
+	t0 = hmac_blake2s(key, data)
+	out, prev = [], b""
+	for i in range(1, n + 1):
+		prev = hmac_blake2s(t0, prev + bytes([i]))
+		out.append(prev)
+	return out
+
+
+def aead_nonce(counter):
+	return b"\x00" * 4 + struct.pack("<Q", counter)
+
+
+def aead_encrypt(key, counter, plaintext, ad):
+	return ChaCha20Poly1305(key).encrypt(aead_nonce(counter), plaintext, ad)
+
+
+def aead_decrypt(key, counter, ciphertext, ad):
+	return ChaCha20Poly1305(key).decrypt(aead_nonce(counter), ciphertext, ad)
+
+
+def _rotl32(v, c):
+	return ((v << c) & 0xffffffff) | (v >> (32 - c))
+
+
+def hchacha20(key, nonce16):
+	s = list(struct.unpack("<4I", b"expand 32-byte k") + struct.unpack("<8I", key) + struct.unpack("<4I", nonce16))
+
+	def qr(a, b, c, d):
+		s[a] = (s[a] + s[b]) & 0xffffffff; s[d] = _rotl32(s[d] ^ s[a], 16)
+		s[c] = (s[c] + s[d]) & 0xffffffff; s[b] = _rotl32(s[b] ^ s[c], 12)
+		s[a] = (s[a] + s[b]) & 0xffffffff; s[d] = _rotl32(s[d] ^ s[a], 8)
+		s[c] = (s[c] + s[d]) & 0xffffffff; s[b] = _rotl32(s[b] ^ s[c], 7)
+
+	for _ in range(10):
+		qr(0, 4, 8, 12); qr(1, 5, 9, 13); qr(2, 6, 10, 14); qr(3, 7, 11, 15)
+		qr(0, 5, 10, 15); qr(1, 6, 11, 12); qr(2, 7, 8, 13); qr(3, 4, 9, 14)
+	return struct.pack("<8I", *(s[0:4] + s[12:16]))
+
+
+def xaead_decrypt(key, nonce24, ciphertext, ad):
+	subkey = hchacha20(key, nonce24[:16])
+	return ChaCha20Poly1305(subkey).decrypt(b"\x00" * 4 + nonce24[16:], ciphertext, ad)
+
+
+def tai64n(ns):
+	return struct.pack(">QI", 0x400000000000000a + ns // 1000000000, ns % 1000000000)
+
+
+def generate_private_key():
+	return X25519PrivateKey.generate().private_bytes(RAW, serialization.PrivateFormat.Raw, serialization.NoEncryption())
+
+
+def public_key(private):
+	return X25519PrivateKey.from_private_bytes(private).public_key().public_bytes(RAW, serialization.PublicFormat.Raw)
+
+
+def dh(private, public):
+	return X25519PrivateKey.from_private_bytes(private).exchange(X25519PublicKey.from_public_bytes(public))
+
+
+class Keypair:
+	def __init__(self, sending_key, receiving_key, receiver_index):
+		self.sending = ChaCha20Poly1305(sending_key)
+		self.receiving = ChaCha20Poly1305(receiving_key)
+		self.receiver_index = receiver_index
+
+	def data(self, counter, packet):
+		packet += b"\x00" * (-len(packet) % 16)
+		header = struct.pack("<I I Q", MESSAGE_DATA, self.receiver_index, counter)
+		return header + self.sending.encrypt(aead_nonce(counter), packet, None)
+
+
+class Initiator:
+	"""One simulated client. The static-static and, unless a fresh ephemeral is
+	requested, ephemeral-static DH results are cached, so that producing an
+	initiation costs only hashing and two small AEAD operations on our side
+	while the responder still performs the full handshake."""
+
+	def __init__(self, private, responder_public, preshared=bytes(32), reuse_ephemeral=True):
+		self.private = private
+		self.public = public_key(private)
+		self.responder_public = responder_public
+		self.preshared = preshared
+		self.reuse_ephemeral = reuse_ephemeral
+		self.ss = dh(private, responder_public)
+		self.mac1_key = blake2s(LABEL_MAC1, responder_public)
+		self.cookie_key = blake2s(LABEL_COOKIE, responder_public)
+		self.cookie = None
+		self.last_mac1 = None
+		self.last_timestamp = 0
+		self.ephemeral = None
+		self.state = None
+		self._new_ephemeral()
+
+	def _new_ephemeral(self):
+		self.ephemeral = generate_private_key()
+		self.ephemeral_public = public_key(self.ephemeral)
+		self.es = dh(self.ephemeral, self.responder_public)
+
+	def _timestamp(self):
+		now = max(time.time_ns(), self.last_timestamp + 1)
+		self.last_timestamp = now
+		return tai64n(now)
+
+	def _macs(self, msg):
+		self.last_mac1 = mac(self.mac1_key, msg)
+		msg += self.last_mac1
+		return msg + (mac(self.cookie, msg) if self.cookie else bytes(16))
+
+	def initiation(self, sender_index):
+		if not self.reuse_ephemeral:
+			self._new_ephemeral()
+		c = blake2s(CONSTRUCTION)
+		h = blake2s(blake2s(c, IDENTIFIER), self.responder_public)
+		c = kdf(c, self.ephemeral_public, 1)[0]
+		h = blake2s(h, self.ephemeral_public)
+		c, k = kdf(c, self.es, 2)
+		encrypted_static = aead_encrypt(k, 0, self.public, h)
+		h = blake2s(h, encrypted_static)
+		c, k = kdf(c, self.ss, 2)
+		encrypted_timestamp = aead_encrypt(k, 0, self._timestamp(), h)
+		h = blake2s(h, encrypted_timestamp)
+		self.state = (sender_index, c, h)
+		msg = struct.pack("<I I", MESSAGE_HANDSHAKE_INITIATION, sender_index) + self.ephemeral_public + encrypted_static + encrypted_timestamp
+		return self._macs(msg)
+
+	def consume_cookie(self, msg):
+		if len(msg) != COOKIE_REPLY_LEN or self.last_mac1 is None:
+			return False
+		try:
+			self.cookie = xaead_decrypt(self.cookie_key, msg[8:32], msg[32:64], self.last_mac1)
+		except Exception:
+			return False
+		return True
+
+	def consume_response(self, msg):
+		if len(msg) != RESPONSE_LEN or self.state is None:
+			return None
+		sender, receiver = struct.unpack_from("<I I", msg, 4)
+		sender_index, c, h = self.state
+		if receiver != sender_index:
+			return None
+		responder_ephemeral = msg[12:44]
+		c = kdf(c, responder_ephemeral, 1)[0]
+		h = blake2s(h, responder_ephemeral)
+		c = kdf(c, dh(self.ephemeral, responder_ephemeral), 1)[0]
+		c = kdf(c, dh(self.private, responder_ephemeral), 1)[0]
+		c, tau, k = kdf(c, self.preshared, 3)
+		h = blake2s(h, tau)
+		try:
+			aead_decrypt(k, 0, msg[44:60], h)
+		except Exception:
+			return None
+		self.state = None
+		sending, receiving = kdf(c, b"", 2)
+		return Keypair(sending, receiving, sender)
+
+
+def junk_initiation():
+	"""An initiation-sized message with a random, therefore invalid, mac1."""
+	return struct.pack("<I", MESSAGE_HANDSHAKE_INITIATION) + os.urandom(INITIATION_LEN - 4)
+
+
+def forged_initiation(responder_public, sender_index):
+	"""An initiation with a valid mac1 but an undecryptable static field, which
+	costs the responder one DH before it is rejected."""
+	msg = struct.pack("<I I", MESSAGE_HANDSHAKE_INITIATION, sender_index) + os.urandom(32 + 48 + 28)
+	return msg + mac(blake2s(LABEL_MAC1, responder_public), msg) + bytes(16)
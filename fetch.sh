@@ -16,13 +16,76 @@ done < <(curl -A "$USER_AGENT" -LSs --connect-timeout 30 https://build.wireguard
 
 [[ -n $VERSION ]]
 
-if [[ -f net/wireguard/version.h && $(< net/wireguard/version.h) == *$VERSION* ]]; then
+if [[ -f net/wireguard/version.h && $(< net/wireguard/version.h) == *$VERSION* && $(< net/wireguard/Kconfig) == *WIREGUARD_CPU_TUNE* ]]; then
 	touch net/wireguard/.check
 	exit 0
 fi
 
-rm -rf net/wireguard
+STAGING="$(mktemp -d net/.wireguard-staging.XXXXXX)"
+trap 'rm -rf "$STAGING"' EXIT
+curl -A "$USER_AGENT" -LsS --connect-timeout 30 "https://git.zx2c4.com/WireGuard/snapshot/WireGuard-$VERSION.tar.xz" | tar -C "$STAGING" -xJf - --strip-components=2 "WireGuard-$VERSION/src"
+sed -i 's/default m/default y/;' "$STAGING/Kconfig"
+
+# Lets WireGuard be tuned for the target CPU and built with an AutoFDO
+# profile, independently of the rest of the kernel. The imported Kbuild
+# already compiles WireGuard with -O3 whatever the kernel's global flags are;
+# these flags are appended after the imported ones.
+cat >> "$STAGING/Kconfig" <<'_EOF'
+
+config WIREGUARD_CPU_TUNE
+	string "Extra compiler flags for CPU tuning"
+	depends on WIREGUARD
+	default ""
+	help
+	  Flags such as "-mcpu=cortex-a75" or "-mtune=skylake" to tune
+	  WireGuard, which is always compiled with -O3, for the target CPU.
+
+config WIREGUARD_AUTOFDO_PROFILE
+	string "AutoFDO sample profile"
+	depends on WIREGUARD
+	default ""
+	help
+	  Path to a sample profile, absolute or relative to the kernel source
+	  tree, to apply with -fprofile-sample-use. This requires a compiler
+	  that supports it, such as clang; otherwise, or if the file does not
+	  exist, the build warns and continues without it.
+_EOF
+KBUILD_FILE="$STAGING/Kbuild"
+[[ -f $KBUILD_FILE ]] || KBUILD_FILE="$STAGING/Makefile"
+cat >> "$KBUILD_FILE" <<'_EOF'
+
+ccflags-y += $(subst ",,$(CONFIG_WIREGUARD_CPU_TUNE))
+WIREGUARD_AUTOFDO_PROFILE := $(subst ",,$(CONFIG_WIREGUARD_AUTOFDO_PROFILE))
+ifneq ($(WIREGUARD_AUTOFDO_PROFILE),)
+WIREGUARD_AUTOFDO_PROFILE := $(if $(filter /%,$(WIREGUARD_AUTOFDO_PROFILE)),,$(srctree)/)$(WIREGUARD_AUTOFDO_PROFILE)
+ifeq ($(wildcard $(WIREGUARD_AUTOFDO_PROFILE)),)
+$(warning WireGuard AutoFDO profile $(WIREGUARD_AUTOFDO_PROFILE) does not exist and is ignored)
+else
+WIREGUARD_AUTOFDO_FLAGS := $(call cc-option,-fprofile-sample-use=$(WIREGUARD_AUTOFDO_PROFILE))
+ifeq ($(WIREGUARD_AUTOFDO_FLAGS),)
+$(warning WireGuard AutoFDO profile $(WIREGUARD_AUTOFDO_PROFILE) is ignored, as the compiler rejects -fprofile-sample-use)
+endif
+ccflags-y += $(WIREGUARD_AUTOFDO_FLAGS)
+endif
+endif
+_EOF
+
+# Only files whose contents changed are replaced, and files dropped from the
+# snapshot removed, so that unchanged sources keep their mtimes and are not
+# rebuilt. The list of imported files is kept in net/wireguard/.files; trees
+# imported without one are replaced entirely once.
+mapfile -t FILES < <(cd "$STAGING" && find . -type f -printf '%P\n' | sort)
+[[ -f net/wireguard/.files ]] || rm -rf net/wireguard
 mkdir -p net/wireguard
-curl -A "$USER_AGENT" -LsS --connect-timeout 30 "https://git.zx2c4.com/WireGuard/snapshot/WireGuard-$VERSION.tar.xz" | tar -C "net/wireguard" -xJf - --strip-components=2 "WireGuard-$VERSION/src"
-sed -i 's/tristate/bool/;s/default m/default y/;' net/wireguard/Kconfig
+if [[ -f net/wireguard/.files ]]; then
+	while read -r file; do
+		[[ -f $STAGING/$file ]] || rm -f "net/wireguard/$file"
+	done < net/wireguard/.files
+fi
+for file in "${FILES[@]}"; do
+	cmp -s "$STAGING/$file" "net/wireguard/$file" && continue
+	mkdir -p "net/wireguard/$(dirname "$file")"
+	cp "$STAGING/$file" "net/wireguard/$file"
+done
+printf '%s\n' "${FILES[@]}" > net/wireguard/.files
 touch net/wireguard/.check